@@ -1,6 +1,6 @@
 /* admin.c 
    - Simple UDP control panel
-   - LIST + BROADCAST
+   - LIST + BROADCAST + STATS (write batching)
 */
 
 #include <stdio.h>
@@ -56,6 +56,7 @@ int main() {
         printf("1) Show active clients\n");
         printf("2) Broadcast message\n");
         printf("3) Exit\n");
+        printf("4) Write batch stats\n");
         printf("-----------------------------\n");
         printf("Choice: ");
 
@@ -76,7 +77,7 @@ int main() {
                     buf[n]=0;
                     printf("\nActive Clients:\n");
                     printf("-----------------------------\n");
-                    printf("Campus       Dept       HB    UDP\n");
+                    printf("Campus       Dept       HB    UDP   SHM\n");
                     printf("-----------------------------\n");
                     printf("%s", buf);
                     printf("-----------------------------\n");
@@ -118,6 +119,24 @@ int main() {
             printf("Exiting admin...\n");
             break;
         }
+        else if (strcmp(choice,"4")==0) {
+            sendto(s,"ADMIN:STATS",11,0,(struct sockaddr*)&srv,sizeof(srv));
+
+            fd_set f; FD_ZERO(&f); FD_SET(s,&f);
+            struct timeval tv={3,0};
+            if (select(s+1,&f,NULL,NULL,&tv) > 0) {
+                char buf[BUF];
+                struct sockaddr_in fr; socklen_t fl=sizeof(fr);
+                int n=recvfrom(s,buf,sizeof(buf)-1,0,
+                               (struct sockaddr*)&fr,&fl);
+                if (n>0) {
+                    buf[n]=0;
+                    printf("\nWrite batches (messages per writev):\n%s",buf);
+                }
+            } else {
+                printf("No reply from server.\n");
+            }
+        }
         else {
             printf("Invalid choice.\n");
         }
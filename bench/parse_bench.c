@@ -0,0 +1,75 @@
+/* parse_bench.c
+   Microbenchmark for the protocol parsers in parse.c.
+   Prints ns/parse for each parser across a range of message sizes.
+   Usage: ./parse_bench [iterations]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../parse.h"
+
+#define BUF 2048
+#define FILL_MAX 1900
+
+static volatile int sink;
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* fill b with n filler chars, stopping short of the recv buffer size */
+static void filler(char *b, int n) {
+    if (n > FILL_MAX) n = FILL_MAX;
+    for (int i=0;i<n;i++) b[i] = 'a' + i % 26;
+    b[n] = 0;
+}
+
+static double benchAuth(const char *msg, long iters) {
+    AuthMsg m;
+    double t0 = nowNs();
+    for (long i=0;i<iters;i++) sink += parseAuth(msg, &m);
+    return (nowNs() - t0) / iters;
+}
+
+static double benchRoute(const char *msg, long iters) {
+    RouteMsg m;
+    double t0 = nowNs();
+    for (long i=0;i<iters;i++) sink += parseRoute(msg, &m);
+    return (nowNs() - t0) / iters;
+}
+
+static double benchHeartbeat(const char *msg, long iters) {
+    HeartbeatMsg m;
+    double t0 = nowNs();
+    for (long i=0;i<iters;i++) sink += parseHeartbeat(msg, &m);
+    return (nowNs() - t0) / iters;
+}
+
+int main(int argc, char **argv) {
+    long iters = argc > 1 ? atol(argv[1]) : 200000;
+    if (iters <= 0) iters = 200000;
+    int sizes[] = {8, 32, 128, 512, 1024, 1800};
+    int nSizes = sizeof(sizes)/sizeof(sizes[0]);
+
+    printf("%-6s %12s %12s %12s %12s\n",
+           "size", "auth", "auth-fb", "route", "heartbeat");
+    for (int s=0;s<nSizes;s++) {
+        char fill[FILL_MAX+1], auth[BUF], authFb[BUF], route[BUF], hb[BUF];
+        filler(fill, sizes[s]);
+        /* field sizes grow with the message, so truncation paths get timed too */
+        snprintf(auth, sizeof(auth), "CAMPUS:LAHORE;DEPT:CS;PASS:%s", fill);
+        snprintf(authFb, sizeof(authFb), "PASS:%s;DEPT:cs;CAMPUS:lahore", fill);
+        snprintf(route, sizeof(route), "LAHORE-CS:%s", fill);
+        snprintf(hb, sizeof(hb), "HEARTBEAT;CAMPUS:%s;DEPT:CS;UDPPORT:40000", fill);
+
+        printf("%-6d %9.1f ns %9.1f ns %9.1f ns %9.1f ns\n", sizes[s],
+               benchAuth(auth, iters), benchAuth(authFb, iters),
+               benchRoute(route, iters), benchHeartbeat(hb, iters));
+    }
+    return 0;
+}
@@ -1,5 +1,6 @@
 /* client.c 
    - TCP connect + authentication
+     (same host: unix socket + shared memory ring, "./client tcp" forces TCP)
    - UDP heartbeat
    - Message routing (menu driven)
    - Clean readable UI
@@ -15,6 +16,9 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/un.h>
+
+#include "ring.h"
 
 #define S_IP "127.0.0.1"
 #define S_TCP 9000
@@ -27,8 +31,38 @@ static void strip(char *s){
     s[strcspn(s,"\n")] = 0;
 }
 
-int main() {
+/* connect to the server's unix socket, -1 if it is not there */
+static int connectLocal(void){
+    struct sockaddr_un xa;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd<0) return -1;
+    memset(&xa,0,sizeof(xa));
+    xa.sun_family = AF_UNIX;
+    strncpy(xa.sun_path, UNIX_PATH, sizeof(xa.sun_path)-1);
+    if (connect(fd, (struct sockaddr*)&xa, sizeof(xa)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* print what the server put in the s2c ring, up to a RING_PAUSE */
+static void drainRing(ShmArea *shm, int *paused){
+    char rb[RING_MSG+1];
+    uint32_t type;
+    while (!*paused && ringPop(&shm->s2c, &type, rb, sizeof(rb)) >= 0) {
+        if (type == RING_PAUSE) *paused = 1;
+        else if (type == RING_BCAST) printf("\n[Admin Broadcast] %s\n", rb);
+        else printf("\n[Message] %s\n", rb);
+    }
+}
+
+int main(int argc, char **argv) {
     int tcpFd=-1, udpFd=-1;
+    int local = 0;
+    ShmArea *shm = NULL;
+    int shmFds[SHM_NFDS] = {-1,-1,-1};
+    int ringPaused = 0;      /* stop popping s2c until SHM_RESUME (ring.h) */
     struct sockaddr_in srvTcp, srvUdp, myUdp;
     char campus[64]={0}, dept[64]={0}, pass[128]={0};
     int myUdpPort=0;
@@ -36,18 +70,25 @@ int main() {
 
     printf("Client starting...\n");
 
-    tcpFd = socket(AF_INET, SOCK_STREAM, 0);
-    if (tcpFd<0){ perror("tcp socket"); return 1; }
+    if (!(argc > 1 && strcmp(argv[1],"tcp")==0)) {
+        tcpFd = connectLocal();
+        local = (tcpFd != -1);
+    }
 
-    memset(&srvTcp,0,sizeof(srvTcp));
-    srvTcp.sin_family = AF_INET;
-    srvTcp.sin_port = htons(S_TCP);
-    inet_pton(AF_INET, S_IP, &srvTcp.sin_addr);
+    if (!local) {
+        tcpFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (tcpFd<0){ perror("tcp socket"); return 1; }
 
-    if (connect(tcpFd, (struct sockaddr*)&srvTcp, sizeof(srvTcp)) < 0) {
-        perror("connect");
-        close(tcpFd);
-        return 1;
+        memset(&srvTcp,0,sizeof(srvTcp));
+        srvTcp.sin_family = AF_INET;
+        srvTcp.sin_port = htons(S_TCP);
+        inet_pton(AF_INET, S_IP, &srvTcp.sin_addr);
+
+        if (connect(tcpFd, (struct sockaddr*)&srvTcp, sizeof(srvTcp)) < 0) {
+            perror("connect");
+            close(tcpFd);
+            return 1;
+        }
     }
 
     udpFd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -89,56 +130,96 @@ int main() {
 
     upcase(campus); upcase(dept);
 
-    printf("\nConnecting...\n");
+    printf("\nConnecting%s...\n", local ? " (local)" : "");
 
-    /* send initial auth */
+    /* send initial auth; local clients ask for the shm ring */
     char authBuf[BUF];
-    snprintf(authBuf, sizeof(authBuf), "CAMPUS:%s;DEPT:%s;PASS:%s",
-             campus, dept, pass);
+    const char *opt = local ? ";SHM:1" : "";
+    snprintf(authBuf, sizeof(authBuf), "CAMPUS:%s;DEPT:%s;PASS:%s%s\n",
+             campus, dept, pass, opt);
     send(tcpFd, authBuf, strlen(authBuf), 0);
 
     time_t lastHB = 0;
+    char inBuf[BUF*2];       /* partial line from the server */
+    int inLen = 0;
     fd_set rfds;
-    int maxfd = (tcpFd > udpFd) ? tcpFd : udpFd;
+    int maxfd;
 
     while (1) {
         FD_ZERO(&rfds);
         FD_SET(tcpFd,&rfds);
         FD_SET(udpFd,&rfds);
         FD_SET(STDIN_FILENO,&rfds);
+        maxfd = (tcpFd > udpFd) ? tcpFd : udpFd;
+        if (shm) {
+            FD_SET(shmFds[SHM_S2C],&rfds);
+            if (shmFds[SHM_S2C] > maxfd) maxfd = shmFds[SHM_S2C];
+        }
 
         struct timeval tv; tv.tv_sec=1; tv.tv_usec=0;
         int r = select(maxfd+1, &rfds, NULL,NULL,&tv);
         if (r < 0) { perror("select"); break; }
 
-        /* heartbeat */
+        /* heartbeat (over the ring when we have one) */
         if (authed) {
             time_t now = time(NULL);
             if (difftime(now, lastHB) >= 7) {
-                char hb[256];
-                snprintf(hb, sizeof(hb),
-                        "HEARTBEAT;CAMPUS:%s;DEPT:%s;UDPPORT:%d",
-                        campus, dept, myUdpPort);
-                sendto(udpFd, hb, strlen(hb),0,
-                       (struct sockaddr*)&srvUdp,sizeof(srvUdp));
+                if (shm) {
+                    ringPush(&shm->c2s, shmFds[SHM_C2S], RING_HB, "", 0);
+                } else {
+                    char hb[256];
+                    snprintf(hb, sizeof(hb),
+                            "HEARTBEAT;CAMPUS:%s;DEPT:%s;UDPPORT:%d",
+                            campus, dept, myUdpPort);
+                    sendto(udpFd, hb, strlen(hb),0,
+                           (struct sockaddr*)&srvUdp,sizeof(srvUdp));
+                }
                 lastHB = now;
             }
         }
 
+        /* shm ring: routed messages and admin broadcasts. Drained before
+           the socket so error replies don't jump ahead of ring messages. */
+        if (shm) {
+            if (FD_ISSET(shmFds[SHM_S2C],&rfds)) ringAck(shmFds[SHM_S2C]);
+            drainRing(shm, &ringPaused);
+        }
+
         /* TCP incoming */
         if (FD_ISSET(tcpFd,&rfds)) {
             char buf[BUF];
-            int n = recv(tcpFd, buf, sizeof(buf)-1,0);
+            int fds[SHM_NFDS], nfds = 0;
+            int n = authed ? recv(tcpFd, buf, sizeof(buf)-1,0)
+                           : recvFds(tcpFd, buf, sizeof(buf)-1, fds, &nfds);
             if (n<=0){
                 printf("Server disconnected.\n");
                 break;
             }
             buf[n]=0;
+            char *rest = buf;        /* lines left after the auth reply */
+            int restLen = n;
 
             if (!authed){
+                char *nl = memchr(buf, '\n', n);
+                restLen = 0;
+                if (nl) {
+                    rest = nl + 1;
+                    restLen = n - (rest - buf);
+                }
                 if (strncmp(buf,"AUTH_OK",7)==0){
                     authed = 1;
 
+                    if (strncmp(buf,"AUTH_OK;SHM",11)==0 && nfds==SHM_NFDS) {
+                        for (int k=0;k<SHM_NFDS;k++) shmFds[k] = fds[k];
+                        if (shmAttach(&shm, shmFds) < 0) shmClose(NULL, shmFds);
+                        else {
+                            ringPaused = 1;
+                            ringPush(&shm->c2s, shmFds[SHM_C2S], RING_HELLO, "", 0);
+                            printf("(shared memory fast path on)\n");
+                        }
+                        nfds = 0;
+                    }
+
                     printf("\n====================================\n");
                     printf(" Logged in as: %s - %s\n", campus, dept);
                     printf("====================================\n");
@@ -148,17 +229,45 @@ int main() {
                     fgets(pass,sizeof(pass),stdin); strip(pass);
 
                     snprintf(authBuf,sizeof(authBuf),
-                             "CAMPUS:%s;DEPT:%s;PASS:%s",
-                             campus,dept,pass);
+                             "CAMPUS:%s;DEPT:%s;PASS:%s%s\n",
+                             campus,dept,pass,opt);
                     send(tcpFd, authBuf, strlen(authBuf),0);
 
                 } else {
                     printf("Server: %s\n", buf);
                 }
             }
-            else {
-                printf("\n[Message] %s\n", buf);
+            if (authed && restLen > 0) {
+                /* server sends "message\n", several may arrive in one recv */
+                if (inLen + restLen >= (int)sizeof(inBuf)) {
+                    inBuf[inLen] = 0;
+                    if (inLen) printf("\n[Message] %s\n", inBuf);
+                    inLen = 0;
+                }
+                memcpy(inBuf + inLen, rest, restLen);
+                inLen += restLen;
+                char *line = inBuf, *nl;
+                while ((nl = memchr(line, '\n', inBuf + inLen - line))) {
+                    *nl = 0;
+                    if (strcmp(line, SHM_RESUME_LINE)==0) {
+                        /* ring messages from before this point come first */
+                        ringPaused = 0;
+                        if (shm) drainRing(shm, &ringPaused);
+                    }
+                    else if (strcmp(line, SHM_OFF_LINE)==0) {
+                        printf("(shared memory fast path off)\n");
+                        if (shm) shmClose(shm, shmFds);
+                        shm = NULL;
+                    }
+                    else if (strncmp(line, SHM_BCAST_PREFIX, strlen(SHM_BCAST_PREFIX))==0)
+                        printf("\n[Admin Broadcast] %s\n", line + strlen(SHM_BCAST_PREFIX));
+                    else if (*line) printf("\n[Message] %s\n", line);
+                    line = nl + 1;
+                }
+                inLen -= line - inBuf;
+                memmove(inBuf, line, inLen);
             }
+            for (int k=0;k<nfds;k++) close(fds[k]);
         }
 
         /* UDP admin broadcast */
@@ -215,11 +324,13 @@ int main() {
 
                 /* build routed message */
                 char final[2048];
-                snprintf(final,sizeof(final),
-                         "%s-%s:%s",
+                int fl = snprintf(final,sizeof(final),
+                         "%s-%s:%s\n",
                          tCampus, tDept, tMsg);
 
-                send(tcpFd, final, strlen(final), 0);
+                /* ring records are already one message each, no '\n' */
+                if (!shm || !ringPush(&shm->c2s, shmFds[SHM_C2S], RING_ROUTE, final, fl-1))
+                    send(tcpFd, final, fl, 0);
 
                 printf("Message sent.\n");
             }
@@ -229,6 +340,7 @@ int main() {
         }
     }
 
+    if (shm) shmClose(shm, shmFds);
     close(tcpFd);
     close(udpFd);
     return 0;
@@ -0,0 +1,29 @@
+/* fuzz_heartbeat.c
+   libFuzzer target for parseHeartbeat().
+   Input is cut to what one recv() can deliver and NUL terminated,
+   the same way server.c hands buffers to the parser.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../parse.h"
+
+#define BUF 2048
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char buf[BUF];
+    if (size > sizeof(buf)-1) size = sizeof(buf)-1;
+    memcpy(buf, data, size);
+    buf[size] = 0;
+
+    HeartbeatMsg m;
+    if (parseHeartbeat(buf, &m)) {
+        /* fields must stay terminated inside their arrays */
+        if (!memchr(m.campus, 0, sizeof(m.campus)) || !m.campus[0]) __builtin_trap();
+        if (!memchr(m.dept, 0, sizeof(m.dept)) || !m.dept[0]) __builtin_trap();
+        if (m.udpPort <= 0 || m.udpPort > 65535) __builtin_trap();
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+/* replay_main.c
+   Stand-in for libFuzzer when the compiler is not clang: runs the
+   fuzz target once over every file given on the command line, so
+   crash inputs and the seed corpus can still be replayed.
+   Usage: ./fuzz_auth fuzz/corpus/auth/ok fuzz/corpus/auth/fallback
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int main(int argc, char **argv) {
+    static uint8_t data[1 << 16];
+    for (int i=1;i<argc;i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) { perror(argv[i]); return 1; }
+        size_t n = fread(data, 1, sizeof(data), f);
+        fclose(f);
+        LLVMFuzzerTestOneInput(data, n);
+        printf("ran %s (%zu bytes)\n", argv[i], n);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+/* parse.c
+   Protocol parsers used by server.c (see parse.h).
+   The ';' separated formats are walked in place instead of strdup+strtok,
+   so a parse costs no malloc and cannot fail on memory.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "parse.h"
+
+void upcase(char *s) { for (; *s; ++s) *s = toupper((unsigned char)*s); }
+
+/* copy n bytes of src into dst, cut to cap-1 and always terminated */
+static void copyField(char *dst, size_t cap, const char *src, size_t n) {
+    if (n > cap-1) n = cap-1;
+    memcpy(dst, src, n);
+    dst[n] = 0;
+}
+
+/* next non-empty ';' token from *p (same tokens strtok would give) */
+static int nextToken(const char **p, const char **tok, size_t *len) {
+    const char *s = *p;
+    while (*s == ';') s++;
+    if (!*s) { *p = s; return 0; }
+    const char *e = strchr(s, ';');
+    if (!e) e = s + strlen(s);
+    *tok = s; *len = (size_t)(e - s);
+    *p = e;
+    return 1;
+}
+
+static int hasKey(const char *tok, size_t len, const char *key, size_t klen) {
+    return len >= klen && memcmp(tok, key, klen) == 0;
+}
+
+int parseAuth(const char *buf, AuthMsg *out) {
+    memset(out, 0, sizeof(*out));
+    if (sscanf(buf, "CAMPUS:%47[^;];DEPT:%47[^;];PASS:%127[^; \t\r\n]",
+               out->campus, out->dept, out->pass) < 3) {
+        /* fallback parsing (some human formats), last key wins */
+        const char *p = buf, *tk; size_t n;
+        while (nextToken(&p, &tk, &n)) {
+            if (hasKey(tk, n, "CAMPUS:", 7)) copyField(out->campus, sizeof(out->campus), tk+7, n-7);
+            else if (hasKey(tk, n, "DEPT:", 5)) copyField(out->dept, sizeof(out->dept), tk+5, n-5);
+            else if (hasKey(tk, n, "PASS:", 5)) copyField(out->pass, sizeof(out->pass), tk+5, n-5);
+        }
+    }
+    if (!out->campus[0] || !out->dept[0] || !out->pass[0]) return 0;
+    /* optional trailing options */
+    const char *p = buf, *tk; size_t n;
+    while (nextToken(&p, &tk, &n)) {
+        if (n == 5 && memcmp(tk, "SHM:1", 5) == 0) out->shm = 1;
+    }
+    upcase(out->campus); upcase(out->dept);
+    return 1;
+}
+
+int parseRoute(const char *buf, RouteMsg *out) {
+    memset(out, 0, sizeof(*out));
+    if (sscanf(buf, "%47[^-]-%47[^:]:%1199[^\n]", out->campus, out->dept, out->body) < 3)
+        return 0;
+    upcase(out->campus); upcase(out->dept);
+    return 1;
+}
+
+int parseHeartbeat(const char *buf, HeartbeatMsg *out) {
+    memset(out, 0, sizeof(*out));
+    if (strncmp(buf, "HEARTBEAT;", 10) != 0) return 0;
+    const char *p = buf + 10, *tk; size_t n;
+    while (nextToken(&p, &tk, &n)) {
+        if (hasKey(tk, n, "CAMPUS:", 7)) copyField(out->campus, sizeof(out->campus), tk+7, n-7);
+        else if (hasKey(tk, n, "DEPT:", 5)) copyField(out->dept, sizeof(out->dept), tk+5, n-5);
+        else if (hasKey(tk, n, "UDPPORT:", 8)) {
+            /* atoi() overflowed on long digit runs; clamp to a real port */
+            char num[16];
+            copyField(num, sizeof(num), tk+8, n-8);
+            long v = strtol(num, NULL, 10);
+            out->udpPort = (v > 0 && v <= 65535 && n-8 < sizeof(num)) ? (int)v : 0;
+        }
+    }
+    if (!out->campus[0] || !out->dept[0] || out->udpPort <= 0) return 0;
+    upcase(out->campus); upcase(out->dept);
+    return 1;
+}
@@ -0,0 +1,48 @@
+/* parse.h
+   Text parsers for the server protocol, kept apart from the socket code
+   so they can be benchmarked and fuzzed on their own.
+     Auth:   CAMPUS:<x>;DEPT:<y>;PASS:<p>[;SHM:1]
+     Route:  TARGETCAMPUS-TARGETDEPT:message
+     HB:     HEARTBEAT;CAMPUS:<x>;DEPT:<y>;UDPPORT:<n>
+   All parsers take a NUL terminated buffer, never write past the
+   fields of the output struct and never allocate.
+*/
+
+#ifndef PARSE_H
+#define PARSE_H
+
+#define NAME_LEN 48
+#define PASS_LEN 128
+#define BODY_LEN 1200
+
+typedef struct {
+    char campus[NAME_LEN];
+    char dept[NAME_LEN];
+    char pass[PASS_LEN];
+    int shm;             /* 0/1, client asked for the shared memory ring */
+} AuthMsg;
+
+typedef struct {
+    char campus[NAME_LEN];
+    char dept[NAME_LEN];
+    char body[BODY_LEN];
+} RouteMsg;
+
+typedef struct {
+    char campus[NAME_LEN];
+    char dept[NAME_LEN];
+    int udpPort;
+} HeartbeatMsg;
+
+void upcase(char *s);
+
+/* 1 if campus, dept and pass were all found (campus/dept upcased), else 0 */
+int parseAuth(const char *buf, AuthMsg *out);
+
+/* 1 if target campus, dept and a non-empty body were found, else 0 */
+int parseRoute(const char *buf, RouteMsg *out);
+
+/* 1 if buf is a HEARTBEAT with campus, dept and a port in 1..65535, else 0 */
+int parseHeartbeat(const char *buf, HeartbeatMsg *out);
+
+#endif
@@ -0,0 +1,148 @@
+/* ring.c
+   Shared memory SPSC rings for local clients (see ring.h).
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "ring.h"
+
+int shmCreate(ShmArea **area, int fds[SHM_NFDS]) {
+    *area = NULL;
+    fds[SHM_MEM] = memfd_create("deptmsg", MFD_CLOEXEC);
+    fds[SHM_C2S] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    fds[SHM_S2C] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fds[SHM_MEM] < 0 || fds[SHM_C2S] < 0 || fds[SHM_S2C] < 0) {
+        perror("memfd/eventfd");
+        shmClose(NULL, fds);
+        return -1;
+    }
+    /* fresh memfd pages are zero, so both rings start empty */
+    if (ftruncate(fds[SHM_MEM], sizeof(ShmArea)) < 0 || shmAttach(area, fds) < 0) {
+        perror("shm setup");
+        shmClose(NULL, fds);
+        return -1;
+    }
+    return 0;
+}
+
+int shmAttach(ShmArea **area, int fds[SHM_NFDS]) {
+    void *p = mmap(NULL, sizeof(ShmArea), PROT_READ | PROT_WRITE, MAP_SHARED, fds[SHM_MEM], 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        *area = NULL;
+        return -1;
+    }
+    *area = p;
+    return 0;
+}
+
+void shmClose(ShmArea *area, int fds[SHM_NFDS]) {
+    if (area) munmap(area, sizeof(ShmArea));
+    for (int i=0;i<SHM_NFDS;i++) {
+        if (fds[i] >= 0) close(fds[i]);
+        fds[i] = -1;
+    }
+}
+
+/* The consumer acks the eventfd and then pops until empty, so the
+   producer only has to wake it when it may have seen an empty ring.
+   head/tail use seq_cst so the producer's tail load cannot pass the
+   consumer's tail store unseen (and the other way round). */
+int ringPush(Ring *r, int efd, uint32_t type, const char *data, int len) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load(&r->tail);
+    if (head - tail >= (type == RING_PAUSE ? RING_SLOTS : RING_SLOTS-1)) return 0;
+    if (len > RING_MSG) len = RING_MSG;
+    if (len < 0) len = 0;
+
+    RingSlot *s = &r->slot[head % RING_SLOTS];
+    s->type = type;
+    s->len = len;
+    memcpy(s->data, data, len);
+    atomic_store(&r->head, head + 1);
+
+    if (atomic_load(&r->tail) == head) ringKick(efd);
+    return 1;
+}
+
+int ringPop(Ring *r, uint32_t *type, char *data, int cap) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load(&r->head);
+    if (tail == head) return -1;
+    if (head - tail > RING_SLOTS) return -2;
+
+    RingSlot *s = &r->slot[tail % RING_SLOTS];
+    int n = s->len;
+    if (n > RING_MSG) n = RING_MSG;   /* the peer wrote it, don't trust it */
+    if (n > cap-1) n = cap-1;
+    *type = s->type;
+    memcpy(data, s->data, n);
+    data[n] = 0;
+    atomic_store(&r->tail, tail + 1);
+    return n;
+}
+
+void ringKick(int efd) {
+    uint64_t one = 1;
+    if (write(efd, &one, sizeof(one)) < 0) { /* counter full: already signalled */ }
+}
+
+void ringAck(int efd) {
+    uint64_t v;
+    if (read(efd, &v, sizeof(v)) < 0) { /* nothing pending */ }
+}
+
+int sendFds(int sock, const char *msg, int len, const int *fds, int nfds) {
+    struct iovec iov = { (void *)msg, len };
+    char ctl[CMSG_SPACE(sizeof(int) * SHM_NFDS)];
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    memset(ctl, 0, sizeof(ctl));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    if (nfds > 0) {
+        if (nfds > SHM_NFDS) nfds = SHM_NFDS;
+        mh.msg_control = ctl;
+        mh.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        struct cmsghdr *c = CMSG_FIRSTHDR(&mh);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(c), fds, sizeof(int) * nfds);
+    }
+    return sendmsg(sock, &mh, 0);
+}
+
+int recvFds(int sock, char *buf, int cap, int *fds, int *nfds) {
+    struct iovec iov = { buf, cap };
+    char ctl[CMSG_SPACE(sizeof(int) * SHM_NFDS)];
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl;
+    mh.msg_controllen = sizeof(ctl);
+    *nfds = 0;
+    int n = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+    if (n < 0) return n;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+            int k = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (int i=0;i<k;i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(c) + i*sizeof(int), sizeof(int));
+                if (*nfds < SHM_NFDS) fds[(*nfds)++] = fd;
+                else close(fd);
+            }
+        }
+    }
+    return n;
+}
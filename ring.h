@@ -0,0 +1,91 @@
+/* ring.h
+   Same-host fast path: a shared memory area with two single-producer
+   single-consumer rings (client->server and server->client) and one
+   eventfd per direction for wakeups.
+   The area and the eventfds are created by the server after a local
+   client authenticates with SHM:1 and are handed over the AF_UNIX
+   socket with SCM_RIGHTS. The socket stays open as the control channel
+   (errors, fallback when a ring is full, disconnect).
+   Ordering between ring and socket:
+   - the client maps the area, pushes RING_HELLO and leaves its s2c
+     ring paused; the server answers with SHM_RESUME on the socket and
+     only then delivers over the ring
+   - when s2c is full the server puts RING_PAUSE in the slot kept free
+     for it and sends on the socket; once the ring has room again it
+     sends SHM_RESUME and goes back to the ring. The client stops
+     popping at RING_PAUSE until it reads SHM_RESUME, so nothing sent
+     on the socket in between is overtaken.
+*/
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define UNIX_PATH "/tmp/deptmsg.sock"
+
+#define RING_SLOTS 64
+#define RING_MSG 2048
+
+/* record types */
+#define RING_ROUTE 1   /* c2s: TARGETCAMPUS-TARGETDEPT:message, s2c: message body */
+#define RING_HB    2   /* c2s: heartbeat, no payload */
+#define RING_BCAST 3   /* s2c: admin broadcast */
+#define RING_HELLO 4   /* c2s: client mapped the area */
+#define RING_PAUSE 5   /* s2c: continue on the socket until SHM_RESUME */
+
+/* control lines on the socket start with this byte; the server
+   rejects message bodies that do */
+#define SHM_CTRL '\001'
+#define SHM_OFF_LINE "\001SHM_OFF"    /* ring dropped, back to socket + UDP */
+#define SHM_RESUME_LINE "\001SHM_RESUME"   /* socket caught up, pop the ring again */
+#define SHM_BCAST_PREFIX "\001BCAST:"     /* admin broadcast sent on the socket */
+
+/* fds passed with AUTH_OK;SHM */
+#define SHM_MEM 0
+#define SHM_C2S 1      /* eventfd the server waits on */
+#define SHM_S2C 2      /* eventfd the client waits on */
+#define SHM_NFDS 3
+
+typedef struct {
+    uint32_t type;
+    uint32_t len;
+    char data[RING_MSG];
+} RingSlot;
+
+typedef struct {
+    _Atomic uint32_t head;   /* written by producer */
+    char pad1[60];
+    _Atomic uint32_t tail;   /* written by consumer */
+    char pad2[60];
+    RingSlot slot[RING_SLOTS];
+} Ring;
+
+typedef struct {
+    Ring c2s;
+    Ring s2c;
+} ShmArea;
+
+/* server side: new zeroed area + eventfds, fds[SHM_NFDS]; 0 ok, -1 error */
+int shmCreate(ShmArea **area, int fds[SHM_NFDS]);
+/* client side: map the area received from the server; 0 ok, -1 error */
+int shmAttach(ShmArea **area, int fds[SHM_NFDS]);
+void shmClose(ShmArea *area, int fds[SHM_NFDS]);
+
+/* 1 pushed, 0 ring full (caller falls back to the socket); len is cut to RING_MSG.
+   The last free slot is kept for RING_PAUSE. */
+int ringPush(Ring *r, int efd, uint32_t type, const char *data, int len);
+/* length of the popped record (data NUL terminated, cap > 0), -1 if empty,
+   -2 if head/tail are impossible (the peer scribbled on the ring) */
+int ringPop(Ring *r, uint32_t *type, char *data, int cap);
+/* reset the eventfd counter; call before draining with ringPop */
+void ringAck(int efd);
+/* wake the consumer waiting on efd */
+void ringKick(int efd);
+
+/* send/recv on an AF_UNIX socket with up to SHM_NFDS fds attached */
+int sendFds(int sock, const char *msg, int len, const int *fds, int nfds);
+int recvFds(int sock, char *buf, int cap, int *fds, int *nfds);
+
+#endif
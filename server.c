@@ -1,14 +1,22 @@
 /* server.c
    Student-ish server 
    - TCP auth + routing
+   - AF_UNIX listener for same-host clients, optional shared memory
+     ring (ring.c) for their routed messages and heartbeats
+   - routed messages are queued per destination and written with one
+     writev() per loop iteration, or after a latency budget:
+       ./server [budget_us]     (default 0 = flush every iteration)
    - UDP heartbeats (clients)
    - UDP admin commands (LIST, BROADCAST)
-   Protocols:
-     Auth:   CAMPUS:<x>;DEPT:<y>;PASS:<p>
+   Protocols (TCP / unix socket input is one message per line):
+     Auth:   CAMPUS:<x>;DEPT:<y>;PASS:<p>[;SHM:1]
+             reply AUTH_OK, or AUTH_OK;SHM + ring fds on the unix socket
      HB:     HEARTBEAT;CAMPUS:<x>;DEPT:<y>;UDPPORT:<n>
      Admin:  ADMIN:LIST
              ADMIN:BROADCAST:<msg>
+             ADMIN:STATS
      Route:  TARGETCAMPUS-TARGETDEPT:message
+             delivered on the stream as "message\n"
 */
 
 #include <stdio.h>
@@ -21,12 +29,22 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "parse.h"
+#include "ring.h"
 
 #define TCP_PORT 9000
 #define UDP_PORT 9001
 #define MAX_CLIENTS 40
 #define BUF 2048
 #define HEART_STALE 60
+#define OUT_MAX 16           /* messages per writev */
+#define OUT_BYTES 16384
+#define HIST_BUCKETS 5       /* batch sizes 1, 2, 3-4, 5-8, 9-16 */
 
 /* small password table (Password System A) */
 struct Pass { char campus[32]; char dept[32]; char pass[64]; };
@@ -48,11 +66,30 @@ typedef struct {
     struct sockaddr_in udpAddr;
     int udpKnown;        /* 0/1 */
     time_t lastHeart;
+    int local;           /* 0/1, came in on the unix socket */
+    ShmArea *shm;        /* set once the ring is handed out */
+    int shmFds[SHM_NFDS];
+    /* input not yet ended by '\n' */
+    char inBuf[2*BUF];
+    int inLen;
+    int framed;          /* 0/1, has sent a '\n'; until then every recv is one message */
+    int shmReady;        /* 0/1, client confirmed the mapping (RING_HELLO) */
+    int shmSpill;        /* 0/1, s2c was full, delivering on the socket */
+    int shmAlive;        /* 0/1, heartbeating over the ring (udpKnown for shm) */
+    /* routed messages waiting for one writev */
+    char outBuf[OUT_BYTES];
+    struct iovec outIov[OUT_MAX];
+    int outN, outUsed;
+    long long outSince;  /* nowUs() when the first one was queued */
+    int corked;          /* 0/1, TCP_CORK held during a burst */
 } Client;
 
 Client clients[MAX_CLIENTS];
 
-void upcase(char *s) { for (; *s; ++s) *s = toupper((unsigned char)*s); }
+long long coalesceUs = 0;
+/* writev batch sizes, see histBucket() */
+unsigned long batchHist[HIST_BUCKETS];
+unsigned long batchCount, batchMsgs;
 
 void initClients() {
     for (int i=0;i<MAX_CLIENTS;i++){
@@ -62,7 +99,137 @@ void initClients() {
         clients[i].authed = 0;
         clients[i].udpKnown = 0;
         clients[i].lastHeart = 0;
+        clients[i].local = 0;
+        clients[i].shm = NULL;
+        clients[i].shmReady = clients[i].shmSpill = clients[i].shmAlive = 0;
+        for (int k=0;k<SHM_NFDS;k++) clients[i].shmFds[k] = -1;
+        clients[i].outN = clients[i].outUsed = 0;
+        clients[i].corked = 0;
+        clients[i].inLen = 0;
+        clients[i].framed = 0;
+    }
+}
+
+long long nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+int histBucket(int n) {
+    int b = 0;
+    while (b < HIST_BUCKETS-1 && n > (1 << b)) b++;
+    return b;
+}
+
+void setCork(int slot, int on) {
+    if (clients[slot].local) return;   /* unix sockets have no Nagle */
+    setsockopt(clients[slot].tcpFd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+    clients[slot].corked = on;
+}
+
+/* write out the queue in one writev. A flush forced by a full queue
+   means a burst is going on, so cork until the final flush of the
+   burst and let the kernel pack full segments; otherwise NODELAY
+   (set at accept) sends right away. */
+void flushOut(int slot, int final) {
+    Client *c = &clients[slot];
+    if (c->outN > 0) {
+        if (!final && !c->corked) setCork(slot, 1);
+        if (writev(c->tcpFd, c->outIov, c->outN) < 0) perror("writev");
+        batchHist[histBucket(c->outN)]++;
+        batchCount++;
+        batchMsgs += c->outN;
+        c->outN = c->outUsed = 0;
+    }
+    if (final && c->corked) setCork(slot, 0);
+}
+
+/* append "msg\n" to a client's queue. The stream is framed by '\n', so
+   a payload with one inside could forge a control line: refuse it. */
+void queueOut(int slot, const char *msg, int len) {
+    Client *c = &clients[slot];
+    if (len > OUT_BYTES-1) len = OUT_BYTES-1;
+    if (memchr(msg, '\n', len)) {
+        printf("[OUT] slot %d: dropped payload with a newline\n", slot);
+        return;
+    }
+    if (c->outN == OUT_MAX || c->outUsed + len + 1 > OUT_BYTES) flushOut(slot, 0);
+    char *p = c->outBuf + c->outUsed;
+    memcpy(p, msg, len);
+    p[len] = '\n';
+    c->outIov[c->outN].iov_base = p;
+    c->outIov[c->outN].iov_len = len + 1;
+    if (c->outN == 0) c->outSince = nowUs();
+    c->outN++;
+    c->outUsed += len + 1;
+}
+
+/* end of a loop iteration: flush every queue whose budget ran out;
+   returns us until the next one is due, -1 if nothing is queued */
+long long flushDue() {
+    long long now = nowUs(), next = -1;
+    for (int i=0;i<MAX_CLIENTS;i++) {
+        if (clients[i].tcpFd == -1 || (!clients[i].outN && !clients[i].corked)) continue;
+        long long left = clients[i].outSince + coalesceUs - now;
+        if (left <= 0 || !clients[i].outN) flushOut(i, 1);
+        else if (next == -1 || left < next) next = left;
     }
+    return next;
+}
+
+void formatStats(char *out, int cap) {
+    static const char *names[HIST_BUCKETS] = {"1", "2", "3-4", "5-8", "9-16"};
+    int k = snprintf(out, cap, "batches=%lu msgs=%lu budget_us=%lld hist:",
+                     batchCount, batchMsgs, coalesceUs);
+    for (int b=0;b<HIST_BUCKETS && k < cap;b++)
+        k += snprintf(out+k, cap-k, " %s=%lu", names[b], batchHist[b]);
+    if (k < cap) snprintf(out+k, cap-k, "\n");
+}
+
+void dropShm(int slot) {
+    if (clients[slot].shm || clients[slot].shmFds[SHM_MEM] != -1)
+        shmClose(clients[slot].shm, clients[slot].shmFds);
+    clients[slot].shm = NULL;
+    clients[slot].shmReady = 0;
+    clients[slot].shmSpill = 0;
+    clients[slot].shmAlive = 0;
+}
+
+/* control reply (errors, auth result) straight to the socket; anything
+   already queued for this client goes first so replies keep their order */
+void reply(int slot, const char *msg, int len) {
+    flushOut(slot, 1);
+    send(clients[slot].tcpFd, msg, len, 0);
+}
+
+/* to a client: over its ring if it has one with room, else its socket
+   (see ring.h for how the two are kept in order) */
+void deliver(int dest, uint32_t type, const char *msg, int len) {
+    Client *c = &clients[dest];
+    if (c->shm && c->shmReady) {
+        Ring *r = &c->shm->s2c;
+        if (ringPush(r, c->shmFds[SHM_S2C], type, msg, len)) {
+            if (c->shmSpill) {
+                queueOut(dest, SHM_RESUME_LINE, strlen(SHM_RESUME_LINE));
+                c->shmSpill = 0;
+            }
+            return;
+        }
+        if (!c->shmSpill) {
+            ringPush(r, c->shmFds[SHM_S2C], RING_PAUSE, "", 0);
+            c->shmSpill = 1;
+        }
+        if (type == RING_BCAST) {
+            /* keep it a broadcast on the socket too */
+            char line[RING_MSG + sizeof(SHM_BCAST_PREFIX)];
+            int k = snprintf(line, sizeof(line), "%s%.*s", SHM_BCAST_PREFIX, len, msg);
+            if (k >= (int)sizeof(line)) k = sizeof(line)-1;
+            queueOut(dest, line, k);
+            return;
+        }
+    }
+    queueOut(dest, msg, len);
 }
 
 int findFreeSlot() {
@@ -95,52 +262,51 @@ int checkPassword(const char *c, const char *d, const char *p) {
 
 /* attempt auth; client may retry if WRONG_PASS */
 void handleAuth(int slot, char *buf) {
-    char camp[48]={0}, dept[48]={0}, pass[128]={0};
-    if (sscanf(buf, "CAMPUS:%47[^;];DEPT:%47[^;];PASS:%127s", camp, dept, pass) < 3) {
-        /* try fallback parsing (some human formats) */
-        char *t = strdup(buf);
-        char *tk = strtok(t, ";");
-        while (tk) {
-            if (strncmp(tk, "CAMPUS:",7)==0) strncpy(camp, tk+7, sizeof(camp)-1);
-            else if (strncmp(tk, "DEPT:",5)==0) strncpy(dept, tk+5, sizeof(dept)-1);
-            else if (strncmp(tk, "PASS:",5)==0) strncpy(pass, tk+5, sizeof(pass)-1);
-            tk = strtok(NULL, ";");
-        }
-        free(t);
-    }
-    if (!camp[0] || !dept[0] || !pass[0]) {
-        send(clients[slot].tcpFd, "SERVER_ERR: bad auth\n", 21, 0);
+    AuthMsg m;
+    if (!parseAuth(buf, &m)) {
+        reply(slot, "SERVER_ERR: bad auth\n", 21);
         return;
     }
-    upcase(camp); upcase(dept);
+    char *camp = m.campus, *dept = m.dept, *pass = m.pass;
     if (checkPassword(camp, dept, pass)) {
         clients[slot].authed = 1;
         strncpy(clients[slot].campus, camp, sizeof(clients[slot].campus)-1);
         strncpy(clients[slot].dept, dept, sizeof(clients[slot].dept)-1);
         clients[slot].udpKnown = 0;
         clients[slot].lastHeart = 0;
-        send(clients[slot].tcpFd, "AUTH_OK\n", 8, 0);
-        printf("[AUTH] slot %d => %s-%s\n", slot, camp, dept);
+        dropShm(slot);
+        if (m.shm && clients[slot].local &&
+            shmCreate(&clients[slot].shm, clients[slot].shmFds) == 0) {
+            flushOut(slot, 1);
+            if (sendFds(clients[slot].tcpFd, "AUTH_OK;SHM\n", 12, clients[slot].shmFds, SHM_NFDS) < 0) {
+                perror("sendmsg");
+                dropShm(slot);
+                reply(slot, "AUTH_OK\n", 8);
+            }
+            printf("[AUTH] slot %d => %s-%s%s\n", slot, camp, dept, clients[slot].shm ? " (shm)" : "");
+        } else {
+            reply(slot, "AUTH_OK\n", 8);
+            printf("[AUTH] slot %d => %s-%s\n", slot, camp, dept);
+        }
     } else {
-        send(clients[slot].tcpFd, "WRONG_PASS\n", 11, 0);
+        reply(slot, "WRONG_PASS\n", 11);
         printf("[AUTH] wrong pass slot %d\n", slot);
     }
 }
 
 /* route a message: TARGETCAMPUS-TARGETDEPT:body */
 void handleRoute(int slot, char *buf) {
-    char tc[48]={0}, td[48]={0}, body[1200]={0};
-    if (sscanf(buf, "%47[^-]-%47[^:]:%1199[^\n]", tc, td, body) < 3) {
-        send(clients[slot].tcpFd, "SERVER_ERR: bad msg\n", 20, 0);
+    RouteMsg m;
+    if (!parseRoute(buf, &m) || m.body[0] == SHM_CTRL) {
+        reply(slot, "SERVER_ERR: bad msg\n", 20);
         return;
     }
-    upcase(tc); upcase(td);
-    int dest = findByCampusDept(tc, td);
+    int dest = findByCampusDept(m.campus, m.dept);
     if (dest == -1) {
-        send(clients[slot].tcpFd, "SERVER_ERR: not connected\n", 26, 0);
+        reply(slot, "SERVER_ERR: not connected\n", 26);
         return;
     }
-    send(clients[dest].tcpFd, body, strlen(body), 0);
+    deliver(dest, RING_ROUTE, m.body, strlen(m.body));
     printf("[ROUTE] %s-%s -> %s-%s\n",
            clients[slot].campus, clients[slot].dept,
            clients[dest].campus, clients[dest].dept);
@@ -164,8 +330,9 @@ void handleUdp(int usock) {
                 if (clients[i].authed) {
                     int ago = clients[i].lastHeart ? (int)difftime(now, clients[i].lastHeart) : -1;
                     char line[200];
-                    snprintf(line, sizeof(line), "%s-%s last=%d udp=%d\n",
-                             clients[i].campus, clients[i].dept, ago, clients[i].udpKnown);
+                    snprintf(line, sizeof(line), "%s-%s last=%d udp=%d shm=%d\n",
+                             clients[i].campus, clients[i].dept, ago, clients[i].udpKnown,
+                             clients[i].shmAlive);
                     strncat(out, line, sizeof(out)-strlen(out)-1);
                 }
             }
@@ -174,12 +341,18 @@ void handleUdp(int usock) {
             return;
         } else if (strncmp(cmd, "BROADCAST:", 10) == 0) {
             char *msg = cmd + 10;
-            if (!msg || !*msg) {
+            if (!msg || !*msg || *msg == SHM_CTRL) {
                 sendto(usock, "ADMIN_ERR: empty\n", 17, 0, (struct sockaddr *)&from, fl);
                 return;
             }
+            if (strpbrk(msg, "\r\n")) {
+                sendto(usock, "ADMIN_ERR: one line only\n", 25, 0, (struct sockaddr *)&from, fl);
+                return;
+            }
             for (int i=0;i<MAX_CLIENTS;i++) {
-                if (clients[i].udpKnown) {
+                if (clients[i].authed && clients[i].shmReady && clients[i].shmAlive) {
+                    deliver(i, RING_BCAST, msg, strlen(msg));
+                } else if (clients[i].udpKnown) {
                     sendto(usock, msg, strlen(msg), 0,
                            (struct sockaddr *)&clients[i].udpAddr, sizeof(clients[i].udpAddr));
                 }
@@ -187,6 +360,11 @@ void handleUdp(int usock) {
             sendto(usock, "ADMIN_OK: sent\n", 14, 0, (struct sockaddr *)&from, fl);
             printf("[ADMIN] broadcast done\n");
             return;
+        } else if (strncmp(cmd, "STATS", 5) == 0) {
+            char out[256];
+            formatStats(out, sizeof(out));
+            sendto(usock, out, strlen(out), 0, (struct sockaddr *)&from, fl);
+            return;
         } else {
             sendto(usock, "ADMIN_ERR: unknown\n", 18, 0, (struct sockaddr *)&from, fl);
             return;
@@ -195,22 +373,12 @@ void handleUdp(int usock) {
 
     /* heartbeat */
     if (strncmp(buf, "HEARTBEAT;", 10)==0) {
-        /* parse roughly */
-        char *dup = strdup(buf);
-        char *tk = strtok(dup, ";");
-        char camp[48]={0}, dept[48]={0}; int uport=0;
-        while (tk) {
-            if (strncmp(tk, "CAMPUS:",7)==0) strncpy(camp, tk+7, sizeof(camp)-1);
-            else if (strncmp(tk, "DEPT:",5)==0) strncpy(dept, tk+5, sizeof(dept)-1);
-            else if (strncmp(tk, "UDPPORT:",8)==0) uport = atoi(tk+8);
-            tk = strtok(NULL, ";");
-        }
-        free(dup);
-        if (!camp[0] || !dept[0] || uport<=0) {
+        HeartbeatMsg hb;
+        if (!parseHeartbeat(buf, &hb)) {
             /* bad hb, ignore */
             return;
         }
-        upcase(camp); upcase(dept);
+        char *camp = hb.campus, *dept = hb.dept; int uport = hb.udpPort;
         /* find client record by campus+dept */
         for (int i=0;i<MAX_CLIENTS;i++) {
             if (clients[i].authed && strcmp(clients[i].campus, camp)==0 &&
@@ -231,21 +399,114 @@ void handleUdp(int usock) {
     }
 }
 
-/* periodic cleanup of stale UDP info */
+/* run every complete line in a client's input buffer */
+void handleLines(int slot) {
+    Client *c = &clients[slot];
+    char *line = c->inBuf, *end = c->inBuf + c->inLen, *nl;
+    while ((nl = memchr(line, '\n', end - line))) {
+        *nl = 0;
+        if (nl > line && nl[-1] == '\r') nl[-1] = 0;
+        if (*line) {
+            if (!c->authed) handleAuth(slot, line);
+            else handleRoute(slot, line);
+        }
+        line = nl + 1;
+    }
+    if (line != c->inBuf) c->framed = 1;
+    c->inLen = end - line;
+    memmove(c->inBuf, line, c->inLen);
+    /* clients that never send '\n' (the original protocol) get one message
+       per recv as before; a line that fills the buffer is taken as is */
+    if (c->inLen && (!c->framed || c->inLen == (int)sizeof(c->inBuf)-1)) {
+        c->inBuf[c->inLen] = 0;
+        if (!c->authed) handleAuth(slot, c->inBuf);
+        else handleRoute(slot, c->inBuf);
+        c->inLen = 0;
+    }
+}
+
+/* drain a local client's ring: routed messages and heartbeats.
+   The client can write the ring memory, so take at most one ring's
+   worth per wakeup and drop the ring if head/tail make no sense. */
+void handleRing(int slot) {
+    Client *c = &clients[slot];
+    char buf[RING_MSG+1];
+    uint32_t type;
+    int n = 0, r = -1;
+    ringAck(c->shmFds[SHM_C2S]);
+    while (c->shm && n < RING_SLOTS && (r = ringPop(&c->shm->c2s, &type, buf, sizeof(buf))) >= 0) {
+        n++;
+        if (type == RING_HB) {
+            c->lastHeart = time(NULL);
+            c->shmAlive = 1;
+            printf("[HB] %s-%s via shm (slot %d)\n", c->campus, c->dept, slot);
+        } else if (type == RING_ROUTE) {
+            handleRoute(slot, buf);
+        } else if (type == RING_HELLO && !c->shmReady) {
+            /* anything already sent on the socket goes ahead of the ring */
+            c->shmReady = 1;
+            queueOut(slot, SHM_RESUME_LINE, strlen(SHM_RESUME_LINE));
+            printf("[SHM] slot %d mapped the ring\n", slot);
+        }
+    }
+    if (!c->shm) return;
+    if (r == -2) {
+        printf("[SHM] corrupt ring slot %d, back to socket\n", slot);
+        dropShm(slot);
+        queueOut(slot, SHM_OFF_LINE, strlen(SHM_OFF_LINE));
+    } else if (n == RING_SLOTS) {
+        ringKick(c->shmFds[SHM_C2S]);   /* more left, come back next loop */
+    }
+}
+
+/* new connection on the TCP or the unix listener */
+void acceptClient(int lfd, int local) {
+    struct sockaddr_storage ca; socklen_t cal = sizeof(ca);
+    int cfd = accept(lfd, (struct sockaddr*)&ca, &cal);
+    if (cfd < 0) { perror("accept"); return; }
+    int slot = findFreeSlot();
+    if (slot == -1) {
+        printf("max clients; reject\n");
+        close(cfd);
+        return;
+    }
+    clients[slot].tcpFd = cfd;
+    clients[slot].authed = 0;
+    clients[slot].udpKnown = 0;
+    clients[slot].lastHeart = 0;
+    clients[slot].campus[0]=0; clients[slot].dept[0]=0;
+    clients[slot].local = local;
+    clients[slot].outN = clients[slot].outUsed = 0;
+    clients[slot].corked = 0;
+    clients[slot].inLen = 0;
+    clients[slot].framed = 0;
+    if (!local) {
+        /* writes are batched here already, Nagle would only add delay */
+        int one = 1;
+        setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    printf("new %s client fd=%d slot=%d\n", local ? "local" : "tcp", cfd, slot);
+}
+
+/* periodic cleanup of stale UDP / ring heartbeat info */
 void pruneStale() {
     time_t now = time(NULL);
     for (int i=0;i<MAX_CLIENTS;i++) {
-        if (clients[i].udpKnown && clients[i].lastHeart &&
+        if ((clients[i].udpKnown || clients[i].shmAlive) && clients[i].lastHeart &&
             difftime(now, clients[i].lastHeart) > HEART_STALE) {
             clients[i].udpKnown = 0;
+            clients[i].shmAlive = 0;
         }
     }
 }
 
-int main() {
-    int listenFd, udpFd;
+int main(int argc, char **argv) {
+    int listenFd, udpFd, unixFd;
     struct sockaddr_in taddr, uaddr;
+    struct sockaddr_un xaddr;
 
+    if (argc > 1) coalesceUs = atoll(argv[1]);
+    if (coalesceUs < 0) coalesceUs = 0;
     initClients();
 
     listenFd = socket(AF_INET, SOCK_STREAM, 0);
@@ -268,26 +529,50 @@ int main() {
     uaddr.sin_port = htons(UDP_PORT);
     if (bind(udpFd, (struct sockaddr *)&uaddr, sizeof(uaddr))<0) { perror("bind udp"); close(listenFd); close(udpFd); return 1; }
 
-    printf("Server running TCP %d UDP %d\n", TCP_PORT, UDP_PORT);
+    /* same-host clients; the server still runs without it */
+    unixFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&xaddr,0,sizeof xaddr);
+    xaddr.sun_family = AF_UNIX;
+    strncpy(xaddr.sun_path, UNIX_PATH, sizeof(xaddr.sun_path)-1);
+    unlink(UNIX_PATH);
+    if (unixFd < 0 || bind(unixFd, (struct sockaddr *)&xaddr, sizeof(xaddr))<0 || listen(unixFd, 8)<0) {
+        perror("unix socket");
+        if (unixFd >= 0) close(unixFd);
+        unixFd = -1;
+    }
+
+    printf("Server running TCP %d UDP %d UNIX %s (coalesce %lld us)\n", TCP_PORT, UDP_PORT,
+           unixFd != -1 ? UNIX_PATH : "off", coalesceUs);
 
     fd_set rfds;
     int maxfd;
     time_t lastPrint = time(NULL);
+    long long due = -1;      /* us until a queue must be flushed */
 
     while (1) {
         FD_ZERO(&rfds);
         FD_SET(listenFd, &rfds);
         FD_SET(udpFd, &rfds);
         maxfd = (listenFd > udpFd) ? listenFd : udpFd;
+        if (unixFd != -1) {
+            FD_SET(unixFd, &rfds);
+            if (unixFd > maxfd) maxfd = unixFd;
+        }
 
         for (int i=0;i<MAX_CLIENTS;i++){
             if (clients[i].tcpFd != -1) {
                 FD_SET(clients[i].tcpFd, &rfds);
                 if (clients[i].tcpFd > maxfd) maxfd = clients[i].tcpFd;
             }
+            if (clients[i].shm) {
+                int efd = clients[i].shmFds[SHM_C2S];
+                FD_SET(efd, &rfds);
+                if (efd > maxfd) maxfd = efd;
+            }
         }
 
         struct timeval tv; tv.tv_sec = 1; tv.tv_usec = 0;
+        if (due >= 0 && due < 1000000) { tv.tv_sec = 0; tv.tv_usec = due; }
         int r = select(maxfd+1, &rfds, NULL, NULL, &tv);
         if (r < 0) { perror("select"); break; }
 
@@ -296,46 +581,38 @@ int main() {
             printf("=== status ===\n");
             for (int i=0;i<MAX_CLIENTS;i++) {
                 if (clients[i].authed) {
-                    printf("slot %d: %s-%s fd=%d udp=%d\n",
-                           i, clients[i].campus, clients[i].dept, clients[i].tcpFd, clients[i].udpKnown);
+                    printf("slot %d: %s-%s fd=%d udp=%d shm=%d\n",
+                           i, clients[i].campus, clients[i].dept, clients[i].tcpFd, clients[i].udpKnown,
+                           clients[i].shmAlive);
                 }
             }
+            char st[256];
+            formatStats(st, sizeof(st));
+            printf("%s", st);
             lastPrint = time(NULL);
             pruneStale();
         }
 
-        /* new TCP connect */
-        if (FD_ISSET(listenFd, &rfds)) {
-            struct sockaddr_in ca; socklen_t cal = sizeof(ca);
-            int cfd = accept(listenFd, (struct sockaddr*)&ca, &cal);
-            if (cfd < 0) perror("accept");
-            else {
-                int slot = findFreeSlot();
-                if (slot == -1) {
-                    printf("max clients; reject\n");
-                    close(cfd);
-                } else {
-                    clients[slot].tcpFd = cfd;
-                    clients[slot].authed = 0;
-                    clients[slot].udpKnown = 0;
-                    clients[slot].lastHeart = 0;
-                    clients[slot].campus[0]=0; clients[slot].dept[0]=0;
-                    printf("new client fd=%d slot=%d\n", cfd, slot);
-                }
-            }
-        }
+        /* new TCP / unix connect */
+        if (FD_ISSET(listenFd, &rfds)) acceptClient(listenFd, 0);
+        if (unixFd != -1 && FD_ISSET(unixFd, &rfds)) acceptClient(unixFd, 1);
 
         /* udp in */
         if (FD_ISSET(udpFd, &rfds)) {
             handleUdp(udpFd);
         }
 
+        /* shm rings */
+        for (int i=0;i<MAX_CLIENTS;i++){
+            if (clients[i].shm && FD_ISSET(clients[i].shmFds[SHM_C2S], &rfds)) handleRing(i);
+        }
+
         /* tcp clients */
         for (int i=0;i<MAX_CLIENTS;i++){
             int fd = clients[i].tcpFd;
             if (fd != -1 && FD_ISSET(fd, &rfds)) {
-                char buf[BUF];
-                int n = recv(fd, buf, sizeof(buf)-1, 0);
+                Client *c = &clients[i];
+                int n = recv(fd, c->inBuf + c->inLen, sizeof(c->inBuf)-1 - c->inLen, 0);
                 if (n <= 0) {
                     printf("client disconnected slot %d\n", i);
                     close(fd);
@@ -344,16 +621,23 @@ int main() {
                     clients[i].udpKnown = 0;
                     clients[i].campus[0]=0; clients[i].dept[0]=0;
                     clients[i].lastHeart = 0;
+                    clients[i].local = 0;
+                    clients[i].outN = clients[i].outUsed = 0;
+                    clients[i].corked = 0;
+                    clients[i].inLen = 0;
+                    dropShm(i);
                 } else {
-                    buf[n]=0;
-                    if (!clients[i].authed) handleAuth(i, buf);
-                    else handleRoute(i, buf);
+                    c->inLen += n;
+                    handleLines(i);
                 }
             }
         }
+
+        due = flushDue();
     }
 
     close(listenFd);
     close(udpFd);
+    if (unixFd != -1) { close(unixFd); unlink(UNIX_PATH); }
     return 0;
 }
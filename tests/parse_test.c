@@ -0,0 +1,90 @@
+/* parse_test.c
+   Checks the parsers in parse.c give the results the server relies on.
+   Prints each failed check and returns the number of failures.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../parse.h"
+
+static int fails;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); fails++; } \
+} while (0)
+
+/* n copies of c, NUL terminated (b must hold n+1) */
+static char *rep(char *b, char c, int n) {
+    memset(b, c, n);
+    b[n] = 0;
+    return b;
+}
+
+static void testAuth(void) {
+    AuthMsg m;
+    char longName[100], longPass[300], buf[512];
+
+    CHECK(parseAuth("CAMPUS:lahore;DEPT:cs;PASS:LHR_CS_123", &m));
+    CHECK(strcmp(m.campus, "LAHORE")==0 && strcmp(m.dept, "CS")==0);
+    CHECK(strcmp(m.pass, "LHR_CS_123")==0);
+    CHECK(m.shm == 0);
+
+    /* SHM:1 option, and the password stops at ';' */
+    CHECK(parseAuth("CAMPUS:lahore;DEPT:cs;PASS:LHR_CS_123;SHM:1", &m));
+    CHECK(m.shm == 1 && strcmp(m.pass, "LHR_CS_123")==0);
+
+    /* fields are cut to 47 / 127 bytes, never overflowed */
+    snprintf(buf, sizeof(buf), "CAMPUS:%s;DEPT:cs;PASS:x", rep(longName, 'a', 80));
+    CHECK(parseAuth(buf, &m));
+    CHECK(strlen(m.campus) == 47);
+    snprintf(buf, sizeof(buf), "CAMPUS:x;DEPT:cs;PASS:%s", rep(longPass, 'p', 200));
+    CHECK(parseAuth(buf, &m));
+    CHECK(strlen(m.pass) == 127);
+
+    /* fallback: any order, empty tokens skipped, last key wins */
+    CHECK(parseAuth("PASS:p;;CAMPUS:karachi;CAMPUS:lahore;DEPT:cs", &m));
+    CHECK(strcmp(m.campus, "LAHORE")==0 && strcmp(m.pass, "p")==0);
+
+    CHECK(!parseAuth("CAMPUS:;DEPT:CS;PASS:x", &m));
+    CHECK(!parseAuth("CAMPUS:LAHORE;DEPT:CS", &m));
+    CHECK(!parseAuth("", &m));
+}
+
+static void testRoute(void) {
+    RouteMsg m;
+    char body[1500], buf[1600];
+
+    CHECK(parseRoute("lahore-cs:hello there", &m));
+    CHECK(strcmp(m.campus, "LAHORE")==0 && strcmp(m.dept, "CS")==0);
+    CHECK(strcmp(m.body, "hello there")==0);
+
+    snprintf(buf, sizeof(buf), "LAHORE-CS:%s", rep(body, 'b', 1400));
+    CHECK(parseRoute(buf, &m));
+    CHECK(strlen(m.body) == 1199);
+
+    CHECK(!parseRoute("LAHORE-CS:", &m));
+    CHECK(!parseRoute("LAHORE:hi", &m));
+}
+
+static void testHeartbeat(void) {
+    HeartbeatMsg m;
+
+    CHECK(parseHeartbeat("HEARTBEAT;CAMPUS:lahore;DEPT:cs;UDPPORT:40000", &m));
+    CHECK(strcmp(m.campus, "LAHORE")==0 && m.udpPort == 40000);
+
+    /* ports outside 1..65535 are rejected, including atoi() overflow */
+    CHECK(!parseHeartbeat("HEARTBEAT;CAMPUS:L;DEPT:C;UDPPORT:65536", &m));
+    CHECK(!parseHeartbeat("HEARTBEAT;CAMPUS:L;DEPT:C;UDPPORT:99999999999999999999", &m));
+    CHECK(!parseHeartbeat("HEARTBEAT;CAMPUS:L;DEPT:C;UDPPORT:0", &m));
+    CHECK(!parseHeartbeat("HEARTBEAT;CAMPUS:L;DEPT:C", &m));
+    CHECK(!parseHeartbeat("CAMPUS:L;DEPT:C;UDPPORT:40000", &m));
+}
+
+int main(void) {
+    testAuth();
+    testRoute();
+    testHeartbeat();
+    printf("%s (%d failed)\n", fails ? "FAILED" : "ok", fails);
+    return fails;
+}